@@ -21,7 +21,10 @@ using Antmicro.Renode.Peripherals.Memory;
 using Antmicro.Renode.Utilities;
 using Antmicro.Renode.Peripherals.SPI.NORFlash;
 using Antmicro.Renode.Core.Structure.Registers;
+using Antmicro.Migrant;
 using System;
+using System.IO;
+using System.IO.MemoryMappedFiles;
 
 using Range = Antmicro.Renode.Core.Range;
 using System.Collections.Generic;
@@ -29,7 +32,7 @@ using System.Collections.Generic;
 namespace Antmicro.Renode.Peripherals.SPI
 {
 
-    public class W25QXX : ISPIPeripheral, IGPIOReceiver
+    public class W25QXX : ISPIPeripheral, IGPIOReceiver, IDisposable
     {
         public W25QXX(MappedMemory underlyingMemory)
         {
@@ -48,12 +51,95 @@ namespace Antmicro.Renode.Peripherals.SPI
 
         public void EraseBytesInRange(Range range)
         {
-            var sector = new byte[range.Size];
-            for (ulong i = 0; i < range.Size; ++i)
+            // erase is a plain fill, so it is written in chunks from one shared erased block
+            for (ulong offset = 0; offset < range.Size; offset += (ulong)ErasedBlock.Length)
             {
-                sector[i] = EmptyByte;
+                var count = (int)Math.Min((ulong)ErasedBlock.Length, range.Size - offset);
+                underlyingMemory.WriteBytes((long)(range.StartAddress + offset), ErasedBlock, 0, count);
+                PersistBytes((long)(range.StartAddress + offset), ErasedBlock, count);
             }
-            underlyingMemory.WriteBytes((long)range.StartAddress, sector);
+        }
+
+        // Flash image file is mapped once per Renode process and shared read-only by every machine
+        // loading it. The CPU fetches XIP code straight from the underlying MappedMemory, which has
+        // to own its storage, so each machine gets a private copy of the image there and its
+        // programs and erases never reach the file. With persist set, they are written through
+        // to the image, so the file always holds the current flash contents.
+        public void LoadImage(ReadFilePath path, bool persist = false)
+        {
+            UnloadImage();
+            long length = new FileInfo(path).Length;
+            if (length > underlyingMemory.Size)
+            {
+                throw new RecoverableException($"Flash image {path} is larger than the flash: {length} > {underlyingMemory.Size}");
+            }
+
+            MemoryMappedFile image;
+            if (persist)
+            {
+                persistedImageFile = MemoryMappedFile.CreateFromFile(path, FileMode.Open, null, 0, MemoryMappedFileAccess.ReadWrite);
+                image = persistedImageFile;
+            }
+            else
+            {
+                image = GetSharedImage(path);
+            }
+
+            using (var view = image.CreateViewAccessor(0, length, MemoryMappedFileAccess.Read))
+            {
+                var chunk = new byte[ErasedBlock.Length];
+                for (long offset = 0; offset < length; offset += chunk.Length)
+                {
+                    var count = (int)Math.Min(chunk.Length, length - offset);
+                    view.ReadArray(offset, chunk, 0, count);
+                    underlyingMemory.WriteBytes(offset, chunk, 0, count);
+                }
+            }
+
+            if (persist)
+            {
+                persistedImage = persistedImageFile.CreateViewAccessor(0, length, MemoryMappedFileAccess.ReadWrite);
+                persistedImageLength = length;
+            }
+            this.Log(LogLevel.Info, "Loaded {0} bytes of flash image{1}: {2}", length, persist ? " (persistent)" : "", (string)path);
+        }
+
+        public void UnloadImage()
+        {
+            persistedImage?.Dispose();
+            persistedImageFile?.Dispose();
+            persistedImage = null;
+            persistedImageFile = null;
+            persistedImageLength = 0;
+        }
+
+        public void Dispose()
+        {
+            UnloadImage();
+        }
+
+        private static MemoryMappedFile GetSharedImage(string path)
+        {
+            var fullPath = Path.GetFullPath(path);
+            lock (SharedImages)
+            {
+                if (!SharedImages.TryGetValue(fullPath, out var image))
+                {
+                    // kept for the lifetime of the process, so machines created later reuse the mapping
+                    image = MemoryMappedFile.CreateFromFile(fullPath, FileMode.Open, null, 0, MemoryMappedFileAccess.Read);
+                    SharedImages[fullPath] = image;
+                }
+                return image;
+            }
+        }
+
+        private void PersistBytes(long position, byte[] data, int count)
+        {
+            if (persistedImage == null || position >= persistedImageLength)
+            {
+                return;
+            }
+            persistedImage.WriteArray(position, data, 0, (int)Math.Min(count, persistedImageLength - position));
         }
 
         private void EraseChip()
@@ -69,6 +155,10 @@ namespace Antmicro.Renode.Peripherals.SPI
                 return;
             }
             underlyingMemory.ZeroAll();
+            for (long offset = 0; offset < persistedImageLength; offset += ZeroBlock.Length)
+            {
+                PersistBytes(offset, ZeroBlock, ZeroBlock.Length);
+            }
         }
 
         public void EraseSector(int sectorSize)
@@ -321,6 +411,27 @@ namespace Antmicro.Renode.Peripherals.SPI
             return underlyingMemory.ReadByte(position);
         }
 
+        // Block variant of the data phase of an ongoing read command, lets the SSI fetch
+        // a whole transfer at once instead of clocking it through Transmit byte by byte
+        public virtual bool TryReadBlock(byte[] destination, int startIndex, int count)
+        {
+            if (currentOperation.State != DecodedOperation.OperationState.HandleCommand
+                || currentOperation.DummyBytesRemaining > 0
+                || (currentOperation.Operation != DecodedOperation.OperationType.Read
+                    && currentOperation.Operation != DecodedOperation.OperationType.ReadFast))
+            {
+                return false;
+            }
+            var position = currentOperation.ExecutionAddress + currentOperation.CommandBytesHandled;
+            if (position + count > underlyingMemory.Size)
+            {
+                return false;
+            }
+            underlyingMemory.ReadBytes(position, count, destination, startIndex);
+            currentOperation.CommandBytesHandled += count;
+            return true;
+        }
+
         protected bool TryVerifyWriteToMemory(out long position)
         {
             position = currentOperation.ExecutionAddress + currentOperation.CommandBytesHandled;
@@ -349,6 +460,10 @@ namespace Antmicro.Renode.Peripherals.SPI
             }
 
             underlyingMemory.WriteByte(position, data);
+            if (position < persistedImageLength)
+            {
+                persistedImage.Write(position, data);
+            }
             return data;
         }
 
@@ -485,6 +600,27 @@ namespace Antmicro.Renode.Peripherals.SPI
         private const byte manufacturerId = 0xEF;
         private const byte memoryType = 0x28;
         private const byte EmptyByte = 0xff;
+
+        private static readonly byte[] ErasedBlock = CreateErasedBlock();
+        private static readonly byte[] ZeroBlock = new byte[ErasedBlock.Length];
+        private static readonly Dictionary<string, MemoryMappedFile> SharedImages = new Dictionary<string, MemoryMappedFile>();
+
+        [Transient]
+        private MemoryMappedFile persistedImageFile;
+        [Transient]
+        private MemoryMappedViewAccessor persistedImage;
+        [Transient]
+        private long persistedImageLength;
+
+        private static byte[] CreateErasedBlock()
+        {
+            var block = new byte[64 * 1024];
+            for (int i = 0; i < block.Length; ++i)
+            {
+                block[i] = EmptyByte;
+            }
+            return block;
+        }
     }
 
 }
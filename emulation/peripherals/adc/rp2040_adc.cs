@@ -24,7 +24,7 @@ using Antmicro.Renode.Utilities.RESD;
 
 namespace Antmicro.Renode.Peripherals.Analog
 {
-  public class RP2040ADC : RP2040PeripheralBase
+  public class RP2040ADC : RP2040PeripheralBase, IRP2040DmaCreditProvider
   {
     public RP2040ADC(IMachine machine, RP2040Clocks clocks, RP2040Pads pads, ulong address) : base(machine, address)
     {
@@ -110,6 +110,7 @@ namespace Antmicro.Renode.Peripherals.Analog
       try
       {
         resdStream[channel] = this.CreateRESDStream<VoltageSample>(filePath, resdChannel, sampleOffsetType, sampleOffsetTime);
+        UpdateSamplingRate();
       }
       catch (RESDException)
       {
@@ -124,11 +125,14 @@ namespace Antmicro.Renode.Peripherals.Analog
       }
     }
 
+    public GPIO DmaWriteRequest => null;
+    public int DmaWriteCredit => 0;
+    public GPIO DmaReadRequest => DMARequest;
+    public int DmaReadCredit => fifo.Count;
+
     public override void Reset()
     {
       dreqEnabled = false;
-      state = State.Waiting;
-      time = 0;
       enabled = false;
       ready = false;
       temperatureSensorEnabled = false;
@@ -157,82 +161,77 @@ namespace Antmicro.Renode.Peripherals.Analog
       onboardTemperature = 25.5;
     }
 
+    // Each tick of the sampling thread completes one conversion, the thread rate is derived
+    // from the conversion period instead of ticking at the ADC clock. Conversions are not
+    // batched: inputs fed from GPIO driven DACs or RESD change between samples, so every
+    // result keeps its own virtual timestamp.
     private void Sample()
     {
-      switch (state)
+      if (!running)
+      {
+        return;
+      }
+
+      CompleteConversion();
+      if (fifoEnabled && dreqEnabled && fifo.Count > 0)
+      {
+        DMARequest.Toggle();
+      }
+    }
+
+    private void CompleteConversion()
+    {
+      conversionResult = GetSampleFromChannel(selectedInput);
+      if (fifoEnabled)
       {
-        case State.Waiting:
+        if (fifo.Count == fifoSize)
+        {
+          fifoOverflowed = true;
+        }
+        else
+        {
+          if (fifoShift)
           {
-            ScheduleNext();
-            return;
+            fifo.Enqueue((ushort)((int)conversionResult >> 4));
           }
-        case State.Delay:
+          else
           {
-            time += 1;
-            if (time >= dividerIntegral + (decimal)dividerFrac / 256)
-            {
-              time = 1;
-              state = State.Sampling;
-            }
-            return;
+            fifo.Enqueue(conversionResult);
           }
-        case State.Sampling:
-          {
-            time += 1;
-            if (time >= (sampleTime - 1))
-            {
-              state = State.SamplingDone;
-            }
-            return;
-          }
-        case State.SamplingDone:
+        }
+
+        if (fifo.Count >= fifoThreshold)
+        {
+          if (fifoIrqEnabled)
           {
-            conversionResult = GetSampleFromChannel(selectedInput);
-            if (fifoEnabled)
-            {
-              if (fifo.Count == fifoSize)
-              {
-                fifoOverflowed = true;
-              }
-              else
-              {
-                if (fifoShift)
-                {
-                  fifo.Enqueue((ushort)((int)conversionResult >> 4));
-                }
-                else
-                {
-                  fifo.Enqueue(conversionResult);
-                }
-              }
-
-              if (fifo.Count >= fifoThreshold)
-              {
-                if (fifoIrqEnabled)
-                {
-                  IRQ.Set(true);
-                }
-              }
-              if (dreqEnabled)
-              {
-                DMARequest.Toggle();
-              }
-            }
-            if (trigger == Trigger.StartOnce)
-            {
-              samplingThread.Stop();
-              trigger = Trigger.Nothing;
-              ready = true;
-              running = false;
-              state = State.Waiting;
-            }
-            else
-            {
-              IterateInput();
-              ScheduleNext();
-            }
-            return;
+            IRQ.Set(true);
           }
+        }
+      }
+      if (trigger == Trigger.StartOnce)
+      {
+        samplingThread.Stop();
+        trigger = Trigger.Nothing;
+        ready = true;
+        running = false;
+      }
+      else
+      {
+        IterateInput();
+      }
+    }
+
+    private void UpdateSamplingRate()
+    {
+      decimal cycles = sampleTime;
+      if (dividerIntegral != 0 || dividerFrac != 0)
+      {
+        cycles = Math.Max(cycles, 1 + dividerIntegral + (decimal)dividerFrac / 256);
+      }
+      var frequency = (uint)Math.Max(1, Math.Round(adcFrequency / cycles));
+      if (frequency != samplingThread.Frequency)
+      {
+        samplingThread.Frequency = frequency;
       }
     }
 
@@ -272,25 +271,6 @@ namespace Antmicro.Renode.Peripherals.Analog
       return ret;
     }
 
-    private void ScheduleNext()
-    {
-      if (trigger == Trigger.Nothing)
-      {
-        return;
-      }
-      ready = false;
-      if (dividerFrac != 0 || dividerIntegral != 0)
-      {
-        if (time < dividerIntegral + (decimal)dividerFrac / 256)
-        {
-          state = State.Delay;
-        }
-        return;
-      }
-      time = 1;
-      state = State.Sampling;
-    }
-
     private void IterateInput()
     {
       if (roundRobinChannels != 0)
@@ -315,7 +295,7 @@ namespace Antmicro.Renode.Peripherals.Analog
           return;
         }
 
-        for (byte c = selectedInput; c < channelsCount; ++c)
+        for (byte c = (byte)(selectedInput + 1); c < channelsCount; ++c)
         {
           if (BitHelper.IsBitSet(roundRobinChannels, c))
           {
@@ -332,19 +312,21 @@ namespace Antmicro.Renode.Peripherals.Analog
 
     private void UpdateFrequency(long frequency)
     {
-      if (frequency != samplingThread.Frequency)
+      if (frequency != adcFrequency)
       {
         samplingThread.Stop();
-        samplingThread.Frequency = (uint)frequency;
+        running = false;
+        adcFrequency = frequency;
         Start();
       }
     }
 
     private void Start()
     {
+      UpdateSamplingRate();
       if (enabled && !running && (trigger != Trigger.Nothing))
       {
-        state = State.Waiting;
+        ready = false;
         samplingThread.Start();
         running = true;
       }
@@ -427,7 +409,11 @@ namespace Antmicro.Renode.Peripherals.Analog
 
       Registers.FCS.Define(this)
         .WithFlag(0, valueProviderCallback: _ => fifoEnabled,
-          writeCallback: (_, value) => fifoEnabled = value,
+          writeCallback: (_, value) =>
+          {
+            fifoEnabled = value;
+            UpdateSamplingRate();
+          },
           name: "EN")
         .WithFlag(1, valueProviderCallback: _ => fifoShift,
           writeCallback: (_, value) => fifoShift = value,
@@ -436,7 +422,11 @@ namespace Antmicro.Renode.Peripherals.Analog
           writeCallback: (_, value) => fifoError = value,
           name: "ERR")
         .WithFlag(3, valueProviderCallback: _ => dreqEnabled,
-          writeCallback: (_, value) => dreqEnabled = value,
+          writeCallback: (_, value) =>
+          {
+            dreqEnabled = value;
+            UpdateSamplingRate();
+          },
           name: "DREQ")
         .WithReservedBits(4, 4)
         .WithFlag(8, FieldMode.Read, valueProviderCallback: _ => fifo.Count == 0,
@@ -453,7 +443,11 @@ namespace Antmicro.Renode.Peripherals.Analog
         .WithValueField(16, 4, FieldMode.Read, valueProviderCallback: _ => (ulong)fifo.Count, name: "LEVEL")
         .WithReservedBits(20, 4)
         .WithValueField(24, 4, valueProviderCallback: _ => fifoThreshold,
-          writeCallback: (_, value) => fifoThreshold = (byte)value,
+          writeCallback: (_, value) =>
+          {
+            fifoThreshold = (byte)value;
+            UpdateSamplingRate();
+          },
           name: "THRESH")
         .WithReservedBits(28, 4);
 
@@ -473,6 +467,7 @@ namespace Antmicro.Renode.Peripherals.Analog
           writeCallback: (_, value) =>
           {
             dividerFrac = (byte)value;
+            UpdateSamplingRate();
             if (value != 0)
             {
               Start();
@@ -482,6 +477,7 @@ namespace Antmicro.Renode.Peripherals.Analog
           writeCallback: (_, value) =>
           {
             dividerIntegral = (ushort)value;
+            UpdateSamplingRate();
             if (value != 0)
             {
               Start();
@@ -568,16 +564,7 @@ namespace Antmicro.Renode.Peripherals.Analog
 
     private const int sampleTime = 96; // in cycles
     private bool samplingStarted = false;
-
-    private enum State
-    {
-      Waiting,
-      Sampling,
-      SamplingDone,
-      Delay
-    };
-    private State state;
-    private int time;
+    private long adcFrequency;
     private RP2040Pads pads;
     private bool running;
     private RESDStream<VoltageSample>[] resdStream;
@@ -104,6 +104,10 @@ namespace Antmicro.Renode.Peripherals.DMA
       {
         channels[i].Reset();
       }
+      pendingChain.Clear();
+      runningChain = false;
+      // DREQ connections are only complete once the platform is loaded
+      dreqOwners = null;
     }
 
     public void Trigger(int channelNumber)
@@ -111,6 +115,70 @@ namespace Antmicro.Renode.Peripherals.DMA
       channels[channelNumber].TriggerTransfer();
     }
 
+    // Credit advertised by the peripheral whose DREQ output is connected to the given input,
+    // null when that DREQ does not come from an IRP2040DmaCreditProvider
+    private int? GetDreqOwnerCredit(int dreq)
+    {
+      if (dreqOwners == null)
+      {
+        dreqOwners = new Dictionary<int, Func<int>>();
+        foreach (var provider in machine.GetPeripheralsOfType<IRP2040DmaCreditProvider>())
+        {
+          AddDreqOwner(provider.DmaWriteRequest, () => provider.DmaWriteCredit);
+          AddDreqOwner(provider.DmaReadRequest, () => provider.DmaReadCredit);
+        }
+      }
+      return dreqOwners.TryGetValue(dreq, out var credit) ? credit() : (int?)null;
+    }
+
+    private void AddDreqOwner(GPIO request, Func<int> credit)
+    {
+      if (request == null)
+      {
+        return;
+      }
+      foreach (var endpoint in request.Endpoints)
+      {
+        if (endpoint.Receiver == this)
+        {
+          dreqOwners[endpoint.Number] = credit;
+        }
+      }
+    }
+
+    // CHAIN_TO hops raised while a chain is already being executed are queued and run
+    // from the same synced state, so control-block sequences don't pay one sync per block.
+    private void Chain(int channelNumber)
+    {
+      if (runningChain)
+      {
+        pendingChain.Enqueue(channelNumber);
+        return;
+      }
+      machine.LocalTimeSource.ExecuteInNearestSyncedState(_ => RunChain(channelNumber));
+    }
+
+    private void RunChain(int channelNumber)
+    {
+      lock (channelFinished)
+      {
+        runningChain = true;
+        pendingChain.Enqueue(channelNumber);
+        var hops = 0;
+        while (pendingChain.Count > 0 && hops++ < MaxChainHopsPerSync)
+        {
+          Trigger(pendingChain.Dequeue());
+        }
+        runningChain = false;
+
+        // endless chains (e.g. ring-buffered control blocks) must not starve the CPUs
+        while (pendingChain.Count > 0)
+        {
+          Chain(pendingChain.Dequeue());
+        }
+      }
+    }
+
     public override uint ReadDoubleWord(long offset)
     {
       if (offset < 0x400)
@@ -353,6 +421,7 @@ namespace Antmicro.Renode.Peripherals.DMA
         ahbError.Value = false;
         InterruptRaised = false;
         transferCounter = 0;
+        targets.Invalidate();
       }
 
       private enum Registers
@@ -424,11 +493,30 @@ namespace Antmicro.Renode.Peripherals.DMA
         ProcessTransfer(true);
       }
 
+      // Number of elements a single DREQ pulse may move, limited by what the peripheral
+      // driving TREQ_SEL advertises. DREQ pulses queued behind a burst find nothing left
+      // to move and get 0. Ring transfers stay element by element.
+      private int GetDreqCredit()
+      {
+        if (ringSize != 0)
+        {
+          return 1;
+        }
+        var credit = parent.GetDreqOwnerCredit(transferRequestSignal) ?? 1;
+        return Math.Min(credit, (int)(transferCount - (uint)transferCounter));
+      }
+
       private void ProcessTransfer(bool paced)
       {
         lock (parent.channelFinished)
         {
-          RPXXXXDmaRequest request = CreateRequest(paced);
+          var elements = paced ? GetDreqCredit() : 1;
+          if (elements == 0)
+          {
+            // an earlier burst already moved what this pulse stands for
+            return;
+          }
+          RPXXXXDmaRequest request = CreateRequest(paced, elements);
           parent.channelFinished[channelNumber] = false;
           if (sniffEnable.Value)
           {
@@ -466,12 +554,12 @@ namespace Antmicro.Renode.Peripherals.DMA
               type = checksumType,
               init = this.parent.sniffData,
             };
-            var response = parent.engine.IssueCopy(request, null, req);
+            var response = parent.engine.IssueCopy(request, null, req, targets);
             this.parent.sniffData = response.crc;
           }
           else
           {
-            var response = parent.engine.IssueCopy(request);
+            var response = parent.engine.IssueCopy(request, null, null, targets);
             if (!paced)
             {
               readAddress = (uint)response.response.ReadAddress.Value;
@@ -481,8 +569,8 @@ namespace Antmicro.Renode.Peripherals.DMA
 
           if (paced)
           {
-            transferCounter++;
-            if (transferCounter == transferCount)
+            transferCounter += elements;
+            if (transferCounter >= transferCount)
             {
               parent.channelFinished[channelNumber] = true;
             }
@@ -500,11 +588,11 @@ namespace Antmicro.Renode.Peripherals.DMA
           }
           if (chainTo != channelNumber && parent.channelFinished[channelNumber])
           {
-            parent.machine.LocalTimeSource.ExecuteInNearestSyncedState(_ => this.parent.Trigger(chainTo));
+            parent.Chain(chainTo);
           }
         }
       }
-      private RPXXXXDmaRequest CreateRequest(bool paced = false)
+      private RPXXXXDmaRequest CreateRequest(bool paced = false, int elements = 1)
       {
         TransferType transferType = TransferType.Byte;
         switch (dataSize.Value)
@@ -521,7 +609,7 @@ namespace Antmicro.Renode.Peripherals.DMA
               break;
             }
         }
-        int size = (int)transferType;
+        int size = (int)transferType * elements;
         if (!paced)
         {
           size *= (int)transferCount;
@@ -608,6 +696,7 @@ namespace Antmicro.Renode.Peripherals.DMA
       private int channelNumber;
 
       private int transferCounter;
+      private readonly RPDmaTargets targets = new RPDmaTargets();
 
     }
 
@@ -616,6 +705,10 @@ namespace Antmicro.Renode.Peripherals.DMA
     private RPDmaEngine engine;
     private int numberOfChannels;
     private bool[] channelFinished;
+    private readonly Queue<int> pendingChain = new Queue<int>();
+    private bool runningChain;
+    private const int MaxChainHopsPerSync = 1024;
+    private Dictionary<int, Func<int>> dreqOwners;
     private IFlagRegisterField sniffEnable;
     private byte sniffChannel;
     private enum CalculateType
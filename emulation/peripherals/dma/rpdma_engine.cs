@@ -8,7 +8,10 @@
 //
 
 using System;
-using System.Linq;
+using System.Buffers;
+using System.Buffers.Binary;
+using System.Runtime.InteropServices;
+using System.Threading;
 using Antmicro.Renode.Debugging;
 using Antmicro.Renode.Peripherals.Bus;
 using Antmicro.Renode.Peripherals.Memory;
@@ -56,14 +59,222 @@ namespace Antmicro.Renode.Peripherals.DMA
     public uint crc { get; set; }
   }
 
+  // Sniffer kernels, semantics follow RP2040 datasheet:
+  // CRCs are calculated MSB first, reversed variants feed bit-reversed data,
+  // so they are computed with reflected tables on bit-reversed accumulator.
+  // Tables are shared and built once, CRCs use slice-by-8.
+  public static class RPDmaChecksum
+  {
+    public static uint Calculate(ChecksumRequest.Type type, uint seed, ReadOnlySpan<byte> data)
+    {
+      switch (type)
+      {
+        case ChecksumRequest.Type.Crc32:
+          return UpdateMsbFirst(crc32Table, seed, data);
+        case ChecksumRequest.Type.Crc32Reversed:
+          return BitHelper.ReverseBits(UpdateLsbFirst(crc32ReversedTable, BitHelper.ReverseBits(seed), data));
+        case ChecksumRequest.Type.Crc16CCITT:
+          // 16-bit CRC is kept in upper half of 32-bit accumulator
+          return UpdateMsbFirst(crc16Table, seed << 16, data) >> 16;
+        case ChecksumRequest.Type.Crc16CCITTReversed:
+          return BitHelper.ReverseBits((ushort)UpdateLsbFirst(crc16ReversedTable, BitHelper.ReverseBits((ushort)seed), data));
+        case ChecksumRequest.Type.XORReduction:
+          return EvenParity(seed, data);
+        case ChecksumRequest.Type.Sum:
+          return Sum(seed, data);
+        default:
+          throw new ArgumentOutOfRangeException($"Checksum type: {type} is not supported by DmaEngine");
+      }
+    }
+
+    public static uint EvenParity(uint seed, ReadOnlySpan<byte> data)
+    {
+      uint calculated = seed;
+      var words = MemoryMarshal.Cast<byte, uint>(data);
+      foreach (var w in words)
+      {
+        calculated ^= w;
+      }
+      for (int i = words.Length * 4; i < data.Length; ++i)
+      {
+        calculated ^= data[i];
+      }
+      // parity of word is the same as parity of its bytes xored together
+      calculated ^= calculated >> 16;
+      calculated ^= calculated >> 8;
+      calculated ^= calculated >> 4;
+      return (0x6996u >> (int)(calculated & 0xf)) & 1;
+    }
+
+    public static uint Sum(uint seed, ReadOnlySpan<byte> data)
+    {
+      uint sum = seed;
+      foreach (var b in data)
+      {
+        sum += b;
+      }
+      return sum;
+    }
+
+    private static uint UpdateMsbFirst(uint[][] t, uint crc, ReadOnlySpan<byte> data)
+    {
+      int i = 0;
+      for (; data.Length - i >= 8; i += 8)
+      {
+        uint one = crc ^ ((uint)data[i] << 24 | (uint)data[i + 1] << 16 | (uint)data[i + 2] << 8 | data[i + 3]);
+        uint two = (uint)data[i + 4] << 24 | (uint)data[i + 5] << 16 | (uint)data[i + 6] << 8 | data[i + 7];
+        crc = t[7][one >> 24] ^ t[6][(one >> 16) & 0xff] ^ t[5][(one >> 8) & 0xff] ^ t[4][one & 0xff]
+          ^ t[3][two >> 24] ^ t[2][(two >> 16) & 0xff] ^ t[1][(two >> 8) & 0xff] ^ t[0][two & 0xff];
+      }
+      for (; i < data.Length; ++i)
+      {
+        crc = (crc << 8) ^ t[0][(crc >> 24) ^ data[i]];
+      }
+      return crc;
+    }
+
+    private static uint UpdateLsbFirst(uint[][] t, uint crc, ReadOnlySpan<byte> data)
+    {
+      int i = 0;
+      for (; data.Length - i >= 8; i += 8)
+      {
+        uint one = crc ^ (data[i] | (uint)data[i + 1] << 8 | (uint)data[i + 2] << 16 | (uint)data[i + 3] << 24);
+        uint two = data[i + 4] | (uint)data[i + 5] << 8 | (uint)data[i + 6] << 16 | (uint)data[i + 7] << 24;
+        crc = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^ t[5][(one >> 16) & 0xff] ^ t[4][one >> 24]
+          ^ t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^ t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+      }
+      for (; i < data.Length; ++i)
+      {
+        crc = (crc >> 8) ^ t[0][(crc ^ data[i]) & 0xff];
+      }
+      return crc;
+    }
+
+    private static uint[][] BuildMsbFirstTable(uint polynomial)
+    {
+      var t = new uint[8][];
+      for (int k = 0; k < 8; ++k)
+      {
+        t[k] = new uint[256];
+      }
+      for (uint i = 0; i < 256; ++i)
+      {
+        uint crc = i << 24;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+          crc = (crc & 0x80000000) != 0 ? (crc << 1) ^ polynomial : crc << 1;
+        }
+        t[0][i] = crc;
+      }
+      for (int k = 1; k < 8; ++k)
+      {
+        for (int i = 0; i < 256; ++i)
+        {
+          t[k][i] = (t[k - 1][i] << 8) ^ t[0][t[k - 1][i] >> 24];
+        }
+      }
+      return t;
+    }
+
+    private static uint[][] BuildLsbFirstTable(uint reflectedPolynomial)
+    {
+      var t = new uint[8][];
+      for (int k = 0; k < 8; ++k)
+      {
+        t[k] = new uint[256];
+      }
+      for (uint i = 0; i < 256; ++i)
+      {
+        uint crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+          crc = (crc & 1) != 0 ? (crc >> 1) ^ reflectedPolynomial : crc >> 1;
+        }
+        t[0][i] = crc;
+      }
+      for (int k = 1; k < 8; ++k)
+      {
+        for (int i = 0; i < 256; ++i)
+        {
+          t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+        }
+      }
+      return t;
+    }
+
+    private static readonly uint[][] crc32Table = BuildMsbFirstTable(0x04C11DB7);
+    private static readonly uint[][] crc32ReversedTable = BuildLsbFirstTable(0xEDB88320);
+    private static readonly uint[][] crc16Table = BuildMsbFirstTable(0x1021u << 16);
+    private static readonly uint[][] crc16ReversedTable = BuildLsbFirstTable(0x8408);
+  }
+
+  // Bus targets resolved for one channel configuration. Paced channels keep the same
+  // READ_ADDR/WRITE_ADDR for thousands of requests, so the lookup is only repeated
+  // when an address changes or peripherals are (un)registered on the bus.
+  public sealed class RPDmaTargets
+  {
+    public void Invalidate()
+    {
+      valid = false;
+    }
+
+    internal bool Matches(ulong sourceAddress, ulong destinationAddress, int busGeneration)
+    {
+      return valid && this.sourceAddress == sourceAddress && this.destinationAddress == destinationAddress && this.busGeneration == busGeneration;
+    }
+
+    internal void Update(ulong sourceAddress, ulong destinationAddress, int busGeneration,
+        IBusRegistered<IBusPeripheral> source, IBusRegistered<IBusPeripheral> destination)
+    {
+      this.sourceAddress = sourceAddress;
+      this.destinationAddress = destinationAddress;
+      this.busGeneration = busGeneration;
+      Source = source;
+      Destination = destination;
+      valid = true;
+    }
+
+    public IBusRegistered<IBusPeripheral> Source { get; private set; }
+    public IBusRegistered<IBusPeripheral> Destination { get; private set; }
+
+    private bool valid;
+    private ulong sourceAddress;
+    private ulong destinationAddress;
+    private int busGeneration;
+  }
+
   public sealed class RPDmaEngine
   {
     public RPDmaEngine(IBusController systemBus)
     {
       sysbus = systemBus;
+      sysbus.Machine.PeripheralsChanged += (_, __) => Interlocked.Increment(ref busGeneration);
+    }
+
+    public ResponseWithCrc IssueCopy(RPXXXXDmaRequest request, CPU.ICPU context = null, ChecksumRequest? checksum = null, RPDmaTargets targets = null)
+    {
+      // paced channels issue one element per request, so the staging buffer is rented instead of allocated
+      var buffer = ArrayPool<byte>.Shared.Rent(request.request.Size);
+      try
+      {
+        return IssueCopy(request, buffer, context, checksum, targets ?? new RPDmaTargets());
+      }
+      finally
+      {
+        ArrayPool<byte>.Shared.Return(buffer);
+      }
     }
 
-    public ResponseWithCrc IssueCopy(RPXXXXDmaRequest request, CPU.ICPU context = null, ChecksumRequest? checksum = null)
+    public void Resolve(RPDmaTargets targets, ulong sourceAddress, ulong destinationAddress, CPU.ICPU context = null)
+    {
+      if (!targets.Matches(sourceAddress, destinationAddress, busGeneration))
+      {
+        targets.Update(sourceAddress, destinationAddress, busGeneration,
+            sysbus.WhatIsAt(sourceAddress, context), sysbus.WhatIsAt(destinationAddress));
+      }
+    }
+
+    private ResponseWithCrc IssueCopy(RPXXXXDmaRequest request, byte[] buffer, CPU.ICPU context, ChecksumRequest? checksum, RPDmaTargets targets)
     {
       var response = new Response
       {
@@ -103,9 +314,10 @@ namespace Antmicro.Renode.Peripherals.DMA
         throw new ArgumentException("Request size is not aligned properly to given read or write transfer type (or both).");
       }
 
-      var buffer = new byte[request.request.Size];
       var sourceAddress = request.request.Source.Address ?? 0;
-      var whatIsAtSource = sysbus.WhatIsAt(sourceAddress, context);
+      var destinationAddress = request.request.Destination.Address ?? 0;
+      Resolve(targets, sourceAddress, destinationAddress, context);
+      var whatIsAtSource = targets.Source;
       var isSourceContinuousMemory = (whatIsAtSource == null || whatIsAtSource.Peripheral is MappedMemory) // Not a peripheral
                                                   && readLengthInBytes == request.request.SourceIncrementStep; // Consistent memory region
       if (!request.request.Source.Address.HasValue)
@@ -124,11 +336,16 @@ namespace Antmicro.Renode.Peripherals.DMA
         }
         else
         {
-          // When reading from the memory with IncrementReadAddress unset, effectively, only the last unit will be used
+          // When reading from the memory with IncrementReadAddress unset every unit is a copy of the first one,
+          // so it is read once and replicated across the staging buffer
           // Transfer Units |  1  |  2  |  3  |  4  |
           // Source         |  A  |  B  |  C  |  D  |
-          // Copied         |  D  |     |     |     |
+          // Copied         |  A  |  A  |  A  |  A  |
           sysbus.ReadBytes(sourceAddress + readOffset, readLengthInBytes, buffer, 0, context: context);
+          for (var filled = readLengthInBytes; filled < request.request.Size; filled *= 2)
+          {
+            Array.Copy(buffer, 0, buffer, filled, Math.Min(filled, request.request.Size - filled));
+          }
         }
       }
       else if (whatIsAtSource != null)
@@ -145,13 +362,13 @@ namespace Antmicro.Renode.Peripherals.DMA
               buffer[transferred] = sysbus.ReadByte(readAddress, context);
               break;
             case TransferType.Word:
-              BitConverter.GetBytes(sysbus.ReadWord(readAddress, context)).CopyTo(buffer, transferred);
+              BinaryPrimitives.WriteUInt16LittleEndian(buffer.AsSpan(transferred), sysbus.ReadWord(readAddress, context));
               break;
             case TransferType.DoubleWord:
-              BitConverter.GetBytes(sysbus.ReadDoubleWord(readAddress, context)).CopyTo(buffer, transferred);
+              BinaryPrimitives.WriteUInt32LittleEndian(buffer.AsSpan(transferred), sysbus.ReadDoubleWord(readAddress, context));
               break;
             case TransferType.QuadWord:
-              BitConverter.GetBytes(sysbus.ReadQuadWord(readAddress, context)).CopyTo(buffer, transferred);
+              BinaryPrimitives.WriteUInt64LittleEndian(buffer.AsSpan(transferred), sysbus.ReadQuadWord(readAddress, context));
               break;
             default:
               throw new ArgumentOutOfRangeException($"Requested read transfer size: {request.request.ReadTransferType} is not supported by DmaEngine");
@@ -169,66 +386,18 @@ namespace Antmicro.Renode.Peripherals.DMA
           }
         }
       }
+      else
+      {
+        // nothing to read from, the rented buffer must not leak data of a previous transfer
+        Array.Clear(buffer, 0, request.request.Size);
+      }
 
       if (checksum != null)
       {
-        switch (checksum.Value.type)
-        {
-          case ChecksumRequest.Type.Crc32Reversed:
-            {
-              var crcEngine = new CRCEngine(CRCPolynomial.CRC32, true, true, checksum.Value.init);
-              responseWithCrc.crc = crcEngine.Calculate(buffer);
-              break;
-            }
-          case ChecksumRequest.Type.Crc32:
-            {
-              var crcEngine = new CRCEngine(CRCPolynomial.CRC32, false, false, checksum.Value.init);
-              responseWithCrc.crc = crcEngine.Calculate(buffer);
-              break;
-            }
-          case ChecksumRequest.Type.Crc16CCITT:
-            {
-              var crcEngine = new CRCEngine(CRCPolynomial.CRC16_CCITT, false, false, checksum.Value.init);
-              responseWithCrc.crc = crcEngine.Calculate(buffer);
-              break;
-            }
-          case ChecksumRequest.Type.Crc16CCITTReversed:
-            {
-              var crcEngine = new CRCEngine(CRCPolynomial.CRC16_CCITT, true, false, checksum.Value.init);
-              responseWithCrc.crc = crcEngine.Calculate(buffer);
-              break;
-            }
-          case ChecksumRequest.Type.XORReduction:
-            {
-              UInt32 calculated = checksum.Value.init;
-              foreach (var b in buffer)
-              {
-                calculated ^= b;
-              }
-              uint bitCount = 0;
-              while (calculated > 0)
-              {
-                bitCount += calculated & 1;
-                calculated >>= 1;
-              }
-              responseWithCrc.crc = Convert.ToUInt32(bitCount % 2 == 1);
-              break;
-            }
-          case ChecksumRequest.Type.Sum:
-            {
-              uint sum = 0;
-              foreach (var b in buffer)
-              {
-                sum += b;
-              }
-              responseWithCrc.crc = sum;
-              break;
-            }
-        }
+        responseWithCrc.crc = RPDmaChecksum.Calculate(checksum.Value.type, checksum.Value.init, new ReadOnlySpan<byte>(buffer, 0, request.request.Size));
       }
 
-      var destinationAddress = request.request.Destination.Address ?? 0;
-      var whatIsAtDestination = sysbus.WhatIsAt(destinationAddress);
+      var whatIsAtDestination = targets.Destination;
       var isDestinationContinuousMemory = (whatIsAtDestination == null || whatIsAtDestination.Peripheral is MappedMemory) // Not a peripheral
                                                   && readLengthInBytes == request.request.DestinationIncrementStep;  // Consistent memory region
       if (!request.request.Destination.Address.HasValue)
@@ -245,28 +414,16 @@ namespace Antmicro.Renode.Peripherals.DMA
             // Transfer Units |  1  |  2  |  3  |  4  |
             // Source         |  A  |  B  |  C  |  D  |
             // Destination    |  A  |  B  |  C  |  D  |
-            WriteToMemory(destinationAddress + writeOffset, buffer, context, request.ringWrite == true ? request.ringSize : 0);
+            WriteToMemory(destinationAddress + writeOffset, buffer, request.request.Size, context, request.ringWrite == true ? request.ringSize : 0);
           }
           else
           {
-            // When writing memory with IncrementReadAddress unset all destination units are written with the first source unit
+            // When writing memory with IncrementReadAddress unset all destination units are written with the first source unit,
+            // which is already replicated across the staging buffer
             // Transfer Units |  1  |  2  |  3  |  4  |
             // Source         |  A  |  B  |  C  |  D  |
             // Destination    |  A  |  A  |  A  |  A  |
-            var chunkStartOffset = 0UL;
-            var chunk = buffer.Take(writeLengthInBytes).ToArray();
-            while (chunkStartOffset < (ulong)request.request.Size)
-            {
-              var writeAddress = destinationAddress + chunkStartOffset;
-              ulong size = (ulong)chunk.Length;
-              if (request.ringSize != 0 && request.ringWrite == true && chunkStartOffset % (ulong)request.ringSize != 0)
-              {
-                // write just what left till full ring
-                size = (ulong)request.ringSize - chunkStartOffset % (ulong)request.ringSize;
-              }
-              sysbus.WriteBytes(chunk, writeAddress + writeOffset, (long)size, false, context: context);
-              chunkStartOffset += size;
-            }
+            sysbus.WriteBytes(buffer, destinationAddress + writeOffset, 0, request.request.Size, context: context);
           }
           if (request.ringSize != 0 && request.ringWrite == true)
           {
@@ -284,8 +441,8 @@ namespace Antmicro.Renode.Peripherals.DMA
           // Source         |  A  |  B  |  C  |  D  |
           // Destination    |  D  |     |     |     |
           var skipCount = (request.request.Size == writeLengthInBytes) ? 0 : request.request.Size - writeLengthInBytes;
-          DebugHelper.Assert((skipCount + request.request.Size) <= buffer.Length);
-          sysbus.WriteBytes(buffer.Skip(skipCount).ToArray(), destinationAddress + writeOffset, context: context);
+          DebugHelper.Assert(request.request.Size <= buffer.Length);
+          sysbus.WriteBytes(buffer, destinationAddress + writeOffset, skipCount, request.request.Size - skipCount, context: context);
         }
       }
       else if (whatIsAtDestination != null)
@@ -333,45 +490,37 @@ namespace Antmicro.Renode.Peripherals.DMA
 
     private int ReadFromMemory(ulong sourceAddress, byte[] buffer, int size, CPU.ICPU context, int ringSize)
     {
-      if (ringSize == 0)
+      // every ring pass reads the same window, so it is fetched once and then repeated inside the buffer
+      var firstChunk = ringSize == 0 ? size : Math.Min(size, ringSize);
+      sysbus.ReadBytes(sourceAddress, firstChunk, buffer, 0, context: context);
+      for (var transferred = firstChunk; transferred < size; transferred += firstChunk)
       {
-        sysbus.ReadBytes(sourceAddress, size, buffer, 0, context: context);
-        return size;
+        Array.Copy(buffer, 0, buffer, transferred, Math.Min(firstChunk, size - transferred));
       }
-
-      int transferred = 0;
-      while (transferred < size)
-      {
-        int chunkSize = size - transferred > ringSize ? ringSize : size - transferred;
-        var chunk = new byte[chunkSize];
-        sysbus.ReadBytes(sourceAddress, chunkSize, chunk, 0, context: context);
-        Array.Copy(chunk, 0, buffer, transferred, chunkSize);
-        transferred += chunkSize;
-      }
-      return size % ringSize;
+      return ringSize == 0 ? size : size % ringSize;
     }
-    private int WriteToMemory(ulong destinationAddress, byte[] buffer, CPU.ICPU context, int ringSize)
+
+    private int WriteToMemory(ulong destinationAddress, byte[] buffer, int size, CPU.ICPU context, int ringSize)
     {
-      int size = buffer.Length;
-      if (ringSize == 0)
+      if (ringSize == 0 || size <= ringSize)
       {
-        sysbus.WriteBytes(buffer, destinationAddress, context: context);
-        return size;
+        sysbus.WriteBytes(buffer, destinationAddress, 0, size, context: context);
+        return ringSize == 0 ? size : size % ringSize;
       }
 
-      int transferred = 0;
-      while (transferred < size)
+      // Only the last pass over the ring survives: its (possibly partial) tail chunk
+      // and whatever the previous full chunk left behind it
+      var lastChunk = size % ringSize;
+      var lastChunkStart = lastChunk == 0 ? size - ringSize : size - lastChunk;
+      if (lastChunk != 0)
       {
-        int chunkSize = size - transferred > ringSize ? ringSize : size - transferred;
-        var chunk = new byte[chunkSize];
-        Array.Copy(buffer, transferred, chunk, 0, chunkSize);
-        sysbus.WriteBytes(chunk, destinationAddress, context: context);
-        transferred += chunkSize;
+        sysbus.WriteBytes(buffer, destinationAddress + (ulong)lastChunk, lastChunkStart - ringSize + lastChunk, ringSize - lastChunk, context: context);
       }
-      return size % ringSize;
+      sysbus.WriteBytes(buffer, destinationAddress, lastChunkStart, lastChunk == 0 ? ringSize : lastChunk, context: context);
+      return lastChunk;
     }
 
-
     private readonly IBusController sysbus;
+    private int busGeneration;
   }
 }
@@ -37,6 +37,8 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
             
             edgeHighState = new bool[NumberOfPins];
             edgeLowState = new bool[NumberOfPins];
+            pinsMask = NumberOfPins >= 32 ? 0xffffffff : (1u << NumberOfPins) - 1;
+            functionBitmaps = new uint[(int)GpioFunction.NONE + 1];
             irqProc = new GpioIrqEnableState[numberOfCores, NumberOfPins];
             irqForced = new GpioIrqEnableState[numberOfCores, NumberOfPins];
 
@@ -358,13 +360,16 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
         public override void Reset()
         {
             base.Reset();
+            stateBitmap = 0;
+            forcedOutputDisableBitmap = 0;
             for (int i = 0; i < NumberOfPins; ++i)
             {
                 functionSelect[i] = 0;
+                UpdateFunctionBitmap(i);
                 pullDown[i] = true;
                 pullUp[i] = false;
-                outputEnableOverride[i] = OutputEnableOverride.Peripheral;
                 forcedOutputDisableMap[i] = false;
+                SetOutputEnableOverride(i, OutputEnableOverride.Peripheral);
                 outputOverride[i] = OutputOverride.Peripheral;
                 peripheralDrive[i] = PeripheralDrive.None;
                 edgeLowState[i] = false;
@@ -420,7 +425,45 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
 
         private bool IsPinOutput(int pin)
         {
-            return forcedOutputDisableMap[pin] == false && outputEnableOverride[pin] != OutputEnableOverride.Disable;
+            return (outputBitmap & (1u << pin)) != 0;
+        }
+
+        private bool IsPinRoutedTo(int pin, GpioFunction peri)
+        {
+            return (functionBitmaps[(int)peri] & (1u << pin)) != 0;
+        }
+
+        // State, output enable and function select are mirrored as packed bitmaps,
+        // so that bulk operations from SIO and PIO can be resolved with masks
+        private void SetState(int pin, bool value)
+        {
+            State[pin] = value;
+            if (value)
+            {
+                stateBitmap |= 1u << pin;
+            }
+            else
+            {
+                stateBitmap &= ~(1u << pin);
+            }
+        }
+
+        private void SetOutputEnableOverride(int pin, OutputEnableOverride value)
+        {
+            uint bit = 1u << pin;
+            outputEnableOverride[pin] = value;
+            enableOverrideBitmap = value == OutputEnableOverride.Enable ? enableOverrideBitmap | bit : enableOverrideBitmap & ~bit;
+            disableOverrideBitmap = value == OutputEnableOverride.Disable ? disableOverrideBitmap | bit : disableOverrideBitmap & ~bit;
+            outputBitmap = (~disableOverrideBitmap & ~forcedOutputDisableBitmap) & pinsMask;
+        }
+
+        private void UpdateFunctionBitmap(int pin)
+        {
+            for (int f = 0; f < functionBitmaps.Length; ++f)
+            {
+                functionBitmaps[f] &= ~(1u << pin);
+            }
+            functionBitmaps[(int)GetFunction(pin)] |= 1u << pin;
         }
 
         public void SubscribeOnFunctionChange(Action<int, GpioFunction> callback)
@@ -521,12 +564,12 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
         {
             if (pullDown[pin] == true)
             {
-                State[pin] = false;
+                SetState(pin, false);
                 Connections[pin].Set(false);
             }
             if (pullUp[pin] == true)
             {
-                State[pin] = true;
+                SetState(pin, true);
                 Connections[pin].Set(true);
             }
         }
@@ -587,6 +630,7 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
                             int[] oldFunctions = new int[NumberOfConnections];
                             functionSelect.CopyTo(oldFunctions, 0);
                             functionSelect[i] = (int)value;
+                            UpdateFunctionBitmap(i);
                             EvaluatePinInterconnections(oldFunctions);
                         },
                         name: "GPIO" + i + "_CTRL_FUNCSEL")
@@ -632,7 +676,7 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
                         writeCallback: (_, value) =>
                         {
                             this.Log(LogLevel.Noisy, "Setting GPIO{0} output enable override to: {1}", i, value);
-                            outputEnableOverride[i] = (OutputEnableOverride)value;
+                            SetOutputEnableOverride(i, (OutputEnableOverride)value);
                             switch (value)
                             {
                                 case 0:
@@ -804,7 +848,7 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
             pullDown[pin] = state;
             if (state == true)
             {
-                State[pin] = false;
+                SetState(pin, false);
                 Connections[pin].Set(false);
             }
         }
@@ -814,14 +858,14 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
             pullUp[pin] = state;
             if (state == true)
             {
-                State[pin] = true;
+                SetState(pin, true);
                 Connections[pin].Set(true);
             }
         }
 
         public void SetPinOutput(int pin, bool state)
         {
-            outputEnableOverride[pin] = state ? OutputEnableOverride.Enable : OutputEnableOverride.Disable;
+            SetOutputEnableOverride(pin, state ? OutputEnableOverride.Enable : OutputEnableOverride.Disable);
         }
 
         // Disable from PADS has greater priority than from GPIO
@@ -833,6 +877,15 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
         public void ForcePinOutputDisable(int pin, bool state)
         {
             forcedOutputDisableMap[pin] = state;
+            if (state)
+            {
+                forcedOutputDisableBitmap |= 1u << pin;
+            }
+            else
+            {
+                forcedOutputDisableBitmap &= ~(1u << pin);
+            }
+            SetOutputEnableOverride(pin, outputEnableOverride[pin]);
         }
 
         public bool GetGpioState(uint number)
@@ -842,33 +895,16 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
 
         public uint GetGpioStateBitmap()
         {
-            lock (State)
-            {
-                uint output = 0;
-                for (int i = 0; i < NumberOfPins; ++i)
-                {
-                    output |= Convert.ToUInt32(State[i]) << i;
-                }
-                return output;
-            }
+            return stateBitmap;
         }
 
         public void SetGpioBitmap(ulong bitmap, GpioFunction peri)
         {
             lock (State)
             {
-                for (int i = 0; i < NumberOfPins; ++i)
-                {
-                    if ((bitmap & (1UL << i)) != 0)
-                    {
-                        WritePin(i, true, peri);
-                    }
-                    else 
-                    {
-                        WritePin(i, false, peri);
-                    }
-
-                }
+                uint changed = ((uint)bitmap ^ stateBitmap) & outputBitmap;
+                DrivePins(changed & (uint)bitmap, true, peri);
+                DrivePins(changed & ~(uint)bitmap, false, peri);
                 OperationDone.Toggle();
             }
         }
@@ -877,13 +913,7 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
         {
             lock (State)
             {
-                for (int i = 0; i < NumberOfPins; ++i)
-                {
-                    if (((bitset & bitmask) & (1UL << i)) != 0)
-                    {
-                        WritePin(i, true, peri);
-                    }
-                }
+                DrivePins((uint)(bitset & bitmask) & ~stateBitmap & outputBitmap, true, peri);
                 OperationDone.Toggle();
             }
         }
@@ -892,17 +922,16 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
         {
             lock (State)
             {
-                for (int i = 0; i < NumberOfPins; ++i)
+                uint mask = (uint)bitmask & pinsMask;
+                uint enable = (uint)bitset & mask;
+                uint disable = ~(uint)bitset & mask;
+                // only pins that are not yet in requested state have to be touched
+                uint changed = (enable & ~enableOverrideBitmap) | (disable & ~disableOverrideBitmap);
+                for (int i = 0; changed != 0; ++i, changed >>= 1)
                 {
-                    if ((bitmask & (1UL << i)) == 0) continue;
-
-                    if ((bitset & (1UL << i)) != 0)
+                    if ((changed & 1) != 0)
                     {
-                        outputEnableOverride[i] = OutputEnableOverride.Enable;
-                    }
-                    else 
-                    {
-                        outputEnableOverride[i] = OutputEnableOverride.Disable;
+                        SetOutputEnableOverride(i, (enable & (1u << i)) != 0 ? OutputEnableOverride.Enable : OutputEnableOverride.Disable);
                     }
                 }
             }
@@ -912,13 +941,7 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
         {
             lock (State)
             {
-                for (int i = 0; i < NumberOfPins; ++i)
-                {
-                    if ((bitset & (1UL << i)) != 0)
-                    {
-                        WritePin(i, false, peri);
-                    }
-                }
+                DrivePins((uint)bitset & stateBitmap & outputBitmap, false, peri);
             }
         }
 
@@ -926,18 +949,25 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
         {
             lock (State)
             {
-                for (int i = 0; i < NumberOfPins; ++i)
+                uint toggled = (uint)bitset & outputBitmap;
+                uint high = stateBitmap;
+                DrivePins(toggled & high, false, peri);
+                DrivePins(toggled & ~high, true, peri);
+            }
+        }
+
+        // drives pins as inputs from outside of the MCU, like OnGPIO does for a single pin
+        public void SetInputBitmap(uint bitmask, uint bitmap)
+        {
+            lock (State)
+            {
+                uint changed = (bitmap ^ stateBitmap) & bitmask & pinsMask;
+                for (int i = 0; changed != 0; ++i, changed >>= 1)
                 {
-                    bool state = State[i];
-                    if ((bitset & (1UL << i)) != 0)
+                    if ((changed & 1) != 0)
                     {
-                        state = state ^ true;
+                        DrivePin(i, (bitmap & (1u << i)) != 0, GetFunction(i));
                     }
-                    else
-                    {
-                        state = state ^ false;
-                    }
-                    WritePin(i, state, peri);
                 }
             }
         }
@@ -951,7 +981,7 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
                     bool enable = (bitset & (1UL << i)) != 0;
                     if (outputEnableOverride[i] == OutputEnableOverride.Peripheral || outputEnableOverride[i] == OutputEnableOverride.InversePeripheral)
                     {
-                        if (GetFunction(i) != peri)
+                        if (!IsPinRoutedTo(i, peri))
                         {
                             continue;
                         }
@@ -965,7 +995,7 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
 
                     if (enable)
                     {
-                        outputEnableOverride[i] = OutputEnableOverride.Disable;
+                        SetOutputEnableOverride(i, OutputEnableOverride.Disable);
                     }
                 }
             }
@@ -982,7 +1012,7 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
                     bool enable = (bitset & (1UL << i)) != 0;
                     if (outputEnableOverride[i] == OutputEnableOverride.Peripheral || outputEnableOverride[i] == OutputEnableOverride.InversePeripheral)
                     {
-                        if (GetFunction(i) != peri)
+                        if (!IsPinRoutedTo(i, peri))
                         {
                             continue;
                         }
@@ -1001,22 +1031,14 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
                     {
                         state = IsPinOutput(i) ^ false;
                     }
-                    outputEnableOverride[i] = state ? OutputEnableOverride.Enable : OutputEnableOverride.Disable;
+                    SetOutputEnableOverride(i, state ? OutputEnableOverride.Enable : OutputEnableOverride.Disable);
                 }
             }
         }
 
         public uint GetOutputEnableBitmap()
         {
-            lock (outputEnableOverride)
-            {
-                uint output = 0;
-                for (int i = 0; i < NumberOfPins; ++i)
-                {
-                    output |= Convert.ToUInt32(outputEnableOverride[i] == OutputEnableOverride.Enable) << i;
-                }
-                return output;
-            }
+            return enableOverrideBitmap;
         }
 
         public void SetOutputEnableBitmap(ulong bitmap, GpioFunction peri)
@@ -1028,7 +1050,7 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
                     bool enable = (bitmap & (1UL << i)) != 0;
                     if (outputEnableOverride[i] == OutputEnableOverride.Peripheral || outputEnableOverride[i] == OutputEnableOverride.InversePeripheral)
                     {
-                        if (GetFunction(i) != peri)
+                        if (!IsPinRoutedTo(i, peri))
                         {
                             continue;
                         }
@@ -1041,11 +1063,11 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
 
                     if (enable)
                     {
-                        outputEnableOverride[i] = OutputEnableOverride.Enable;
+                        SetOutputEnableOverride(i, OutputEnableOverride.Enable);
                     }
                     else
                     {
-                        outputEnableOverride[i] = OutputEnableOverride.Disable;
+                        SetOutputEnableOverride(i, OutputEnableOverride.Disable);
                     }
                 }
             }
@@ -1065,7 +1087,7 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
                     bool enable = (bitset & (1UL << i)) != 0;
                     if (outputEnableOverride[i] == OutputEnableOverride.Peripheral || outputEnableOverride[i] == OutputEnableOverride.InversePeripheral)
                     {
-                        if (GetFunction(i) != peri)
+                        if (!IsPinRoutedTo(i, peri))
                         {
                             continue;
                         }
@@ -1078,7 +1100,7 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
 
                     if (enable)
                     {
-                        outputEnableOverride[i] = OutputEnableOverride.Enable;
+                        SetOutputEnableOverride(i, OutputEnableOverride.Enable);
                     }
                 }
             }
@@ -1098,6 +1120,7 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
         {
             WritePin(number, value, GetFunction(number), true);
             base.OnGPIO(number, value);
+            SetState(number, State[number]);
         }
 
         // most probably may hide some bugs, but full emulation of gpio function interconnection may not be necessary in most cases
@@ -1123,9 +1146,26 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
                 return;
             }
 
-            this.Log(LogLevel.Noisy, "Setting GPIO" + number + " to: " + value + ", time: " + machine.ElapsedVirtualTime.TimeElapsed + ", from: " + peri);
+            DrivePin(number, value, peri);
+        }
 
-            if (peripheralDrive[number] != PeripheralDrive.None && GetFunction(number) != peri)
+        // pins must be already filtered, only real changes of output pins are expected here
+        private void DrivePins(uint pins, bool value, GpioFunction peri)
+        {
+            for (int i = 0; pins != 0; ++i, pins >>= 1)
+            {
+                if ((pins & 1) != 0)
+                {
+                    DrivePin(i, value, peri);
+                }
+            }
+        }
+
+        private void DrivePin(int number, bool value, GpioFunction peri)
+        {
+            this.Log(LogLevel.Noisy, "Setting GPIO{0} to: {1}, time: {2}, from: {3}", number, value, machine.ElapsedVirtualTime.TimeElapsed, peri);
+
+            if (peripheralDrive[number] != PeripheralDrive.None && !IsPinRoutedTo(number, peri))
             {
                 this.Log(LogLevel.Error, "Driving GPIO from not selected peripheral, gpio configured with: " + GetFunction(number) + ". Request received from: " + peri);
             }
@@ -1134,7 +1174,7 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
             {
                 value = !value;
             }
-            State[number] = value;
+            SetState(number, value);
 
             // we have edge, so mark it
             if (value)
@@ -1320,6 +1360,14 @@ namespace Antmicro.Renode.Peripherals.GPIOPort
         private OutputEnableOverride[] outputEnableOverride;
         private bool[] forcedOutputDisableMap;
 
+        private readonly uint pinsMask;
+        private uint stateBitmap;
+        private uint outputBitmap;
+        private uint enableOverrideBitmap;
+        private uint disableOverrideBitmap;
+        private uint forcedOutputDisableBitmap;
+        private uint[] functionBitmaps;
+
         private List<Action<int, GpioFunction>> functionSelectCallbacks;
 
         private enum PeripheralDrive
@@ -1,19 +1,24 @@
 using Antmicro.Renode.Core;
 using System;
 using System.IO;
+using System.IO.MemoryMappedFiles;
 using Antmicro.Renode.Logging;
 
 using Antmicro.Renode.Time;
 using ELFSharp.ELF;
 
 using Antmicro.Renode.Peripherals.Miscellaneous;
+using Antmicro.Renode.Utilities;
 using Antmicro.Renode.Utilities.Binding;
+using Antmicro.Renode.Exceptions;
 using Antmicro.Migrant;
 using Antmicro.Renode.Peripherals.Bus;
 using System.Runtime.CompilerServices;
 using System.Runtime.InteropServices;
 using System.Diagnostics;
 using System.Collections;
+using System.Collections.Concurrent;
+using System.Threading;
 
 namespace Antmicro.Renode.Peripherals.CPU
 {
@@ -100,7 +105,10 @@ namespace Antmicro.Renode.Peripherals.CPU
             machine.GetSystemBus(this).Register(this, new BusMultiRegistration(address + clearAliasOffset, aliasSize, "CLEAR"));
             gpio.ReevaluatePioActions.Add((uint steps) =>
             {
-                totalExecutedInstructions += PioExecute(pioId, steps);
+                lock (this)
+                {
+                    totalExecutedInstructions += ExecuteSteps(steps);
+                }
             });
             clocks.OnSystemClockChange(UpdateClocks);
 
@@ -110,39 +118,189 @@ namespace Antmicro.Renode.Peripherals.CPU
         [ConnectionRegion("XOR")]
         public virtual void WriteDoubleWordXor(long offset, uint value)
         {
-            PioWriteMemory(pioId, (uint)offset, PioReadMemory(pioId, (uint)offset) ^ value);
+            NoteBusAccess(offset, true);
+            // read-modify-write must not interleave with PIO execution
+            lock (this)
+            {
+                WriteMemory(offset, ReadMemory(offset) ^ value);
+            }
         }
 
         [ConnectionRegion("SET")]
         public virtual void WriteDoubleWordSet(long offset, uint value)
         {
-            PioWriteMemory(pioId, (uint)offset, PioReadMemory(pioId, (uint)offset) | value);
+            NoteBusAccess(offset, true);
+            lock (this)
+            {
+                WriteMemory(offset, ReadMemory(offset) | value);
+            }
         }
 
         [ConnectionRegion("CLEAR")]
         public virtual void WriteDoubleWordClear(long offset, uint value)
         {
-            PioWriteMemory(pioId, (uint)offset, PioReadMemory(pioId, (uint)offset) & (~value));
+            NoteBusAccess(offset, true);
+            lock (this)
+            {
+                WriteMemory(offset, ReadMemory(offset) & (~value));
+            }
         }
 
         [ConnectionRegion("XOR")]
         public virtual uint ReadDoubleWordXor(long offset)
         {
-            return PioReadMemory(pioId, (uint)offset);
+            NoteBusAccess(offset, false);
+            lock (this)
+            {
+                return ReadMemory(offset);
+            }
         }
 
         [ConnectionRegion("SET")]
         public virtual uint ReadDoubleWordSet(long offset)
         {
-            return PioReadMemory(pioId, (uint)offset);
+            NoteBusAccess(offset, false);
+            lock (this)
+            {
+                return ReadMemory(offset);
+            }
         }
 
         [ConnectionRegion("CLEAR")]
         public virtual uint ReadDoubleWordClear(long offset)
         {
+            NoteBusAccess(offset, false);
+            lock (this)
+            {
+                return ReadMemory(offset);
+            }
+        }
+
+        // Stimulus file is a sequence of little endian records sorted by cycle:
+        // u64 cycle (PIO cycles since load), u32 pins mask, u32 pins state.
+        // Edges are applied before execution of the cycle they are stamped with.
+        public void LoadInputStimulus(ReadFilePath path)
+        {
+            lock (this)
+            {
+                UnloadInputStimulus();
+                long length = new FileInfo(path).Length;
+                if (length == 0 || length % StimulusRecordSize != 0)
+                {
+                    throw new RecoverableException($"Stimulus file {path} must contain {StimulusRecordSize} byte records");
+                }
+                stimulusFile = MemoryMappedFile.CreateFromFile(path, FileMode.Open, null, 0, MemoryMappedFileAccess.Read);
+                stimulus = stimulusFile.CreateViewAccessor(0, length, MemoryMappedFileAccess.Read);
+                stimulusRecords = length / StimulusRecordSize;
+                stimulusIndex = 0;
+                stimulusCycle = 0;
+                this.Log(LogLevel.Info, "Loaded {0} input stimulus records from: {1}", stimulusRecords, (string)path);
+            }
+        }
+
+        public void UnloadInputStimulus()
+        {
+            lock (this)
+            {
+                stimulus?.Dispose();
+                stimulusFile?.Dispose();
+                stimulus = null;
+                stimulusFile = null;
+                stimulusRecords = 0;
+            }
+        }
+
+        private ulong ExecuteSteps(ulong steps)
+        {
+            if (stimulus == null)
+            {
+                return Execute((uint)steps);
+            }
+
+            ulong executed = 0;
+            while (steps > 0)
+            {
+                ApplyDueStimulus();
+                ulong chunk = steps;
+                if (stimulusIndex < stimulusRecords)
+                {
+                    chunk = Math.Min(chunk, stimulus.ReadUInt64(stimulusIndex * StimulusRecordSize) - stimulusCycle);
+                }
+                executed += Execute((uint)chunk);
+                stimulusCycle += chunk;
+                steps -= chunk;
+            }
+            ApplyDueStimulus();
+            return executed;
+        }
+
+        // every call into piosim goes through these helpers to keep counters up to date
+        private ulong Execute(uint steps)
+        {
+            ApplyPendingWrites();
+            long start = Stopwatch.GetTimestamp();
+            ulong executed = PioExecute(pioId, steps);
+            hostExecutionTicks += Stopwatch.GetTimestamp() - start;
+            simulatedCycles += steps;
+            ++nativeCalls;
+            return executed;
+        }
+
+        private uint ReadMemory(long offset)
+        {
+            ApplyPendingWrites();
+            ++nativeCalls;
             return PioReadMemory(pioId, (uint)offset);
         }
 
+        private void WriteMemory(long offset, uint value)
+        {
+            TrackControlWrite(offset, value);
+            ApplyPendingWrites();
+            ++nativeCalls;
+            PioWriteMemory(pioId, (uint)offset, value);
+        }
+
+        // must be called with lock taken
+        private void ApplyPendingWrites()
+        {
+            while (pendingWrites.TryDequeue(out PendingWrite write))
+            {
+                ++nativeCalls;
+                PioWriteMemory(pioId, (uint)write.Offset, write.Value);
+            }
+        }
+
+        private void TrackControlWrite(long offset, uint value)
+        {
+            if (offset == ControlOffset)
+            {
+                anyStateMachineEnabled = (value & StateMachineEnableMask) != 0;
+            }
+        }
+
+        public void ResetCounters()
+        {
+            simulatedCycles = 0;
+            nativeCalls = 0;
+            gpioCallbacks = 0;
+            hostExecutionTicks = 0;
+        }
+
+        private void ApplyDueStimulus()
+        {
+            while (stimulusIndex < stimulusRecords)
+            {
+                long position = stimulusIndex * StimulusRecordSize;
+                if (stimulus.ReadUInt64(position) > stimulusCycle)
+                {
+                    return;
+                }
+                gpio.SetInputBitmap(stimulus.ReadUInt32(position + 8), stimulus.ReadUInt32(position + 12));
+                ++stimulusIndex;
+            }
+        }
+
         private void UpdateClocks(long systemClockFrequency)
         {
             uint newPerformance = (uint)(systemClockFrequency / 1000000);
@@ -167,6 +325,14 @@ namespace Antmicro.Renode.Peripherals.CPU
 
             instructionsExecutedThisRound = 0;
             totalExecutedInstructions = 0;
+            stimulusIndex = 0;
+            stimulusCycle = 0;
+            ResetCounters();
+            quantumSlice = MaximumQuantumSlice;
+            anyStateMachineEnabled = false;
+            while (pendingWrites.TryDequeue(out _))
+            {
+            }
             PioReset(pioId);
             // [Here goes an invocation resetting the external simulator (if needed)]
             // [This can be used to revert the internal state of the simulator to the initial form]
@@ -174,17 +340,38 @@ namespace Antmicro.Renode.Peripherals.CPU
 
         public virtual uint ReadDoubleWord(long offset)
         {
+            NoteBusAccess(offset, false);
             lock (this)
             {
-                return (uint)PioReadMemory(pioId, (uint)offset);
+                return ReadMemory(offset);
             }
         }
 
         public virtual void WriteDoubleWord(long offset, uint value)
         {
-            lock (this)
+            NoteBusAccess(offset, true);
+            // Do not stall the bus master while PIO executes its quantum.
+            // Queued writes are applied in order before the next access to piosim.
+            bool taken = false;
+            Monitor.TryEnter(this, ref taken);
+            if (!taken)
             {
-                PioWriteMemory(pioId, (uint)offset, (uint)value);
+                if (pendingWrites.Count < MaxPendingWrites)
+                {
+                    TrackControlWrite(offset, value);
+                    pendingWrites.Enqueue(new PendingWrite { Offset = offset, Value = value });
+                    return;
+                }
+                Monitor.Enter(this, ref taken);
+            }
+
+            try
+            {
+                WriteMemory(offset, value);
+            }
+            finally
+            {
+                Monitor.Exit(this);
             }
         }
 
@@ -192,6 +379,7 @@ namespace Antmicro.Renode.Peripherals.CPU
         {
             lock (this)
             {
+                UnloadInputStimulus();
                 PioDeinitialize(pioId);
 
                 base.Dispose();
@@ -227,9 +415,18 @@ namespace Antmicro.Renode.Peripherals.CPU
             {
                 // [Here comes the invocation of the external simulator for the given amount of instructions]
                 // [This is the place where simulation of acutal instructions is to be executed]
-                lock (this)
+                ulong toExecute = numberOfInstructionsToExecute;
+                while (toExecute > 0)
                 {
-                    instructionsExecutedThisRound += (ulong)PioExecute(pioId, (uint)numberOfInstructionsToExecute);
+                    ulong slice = Math.Min(toExecute, quantumSlice);
+                    long accesses = Interlocked.Read(ref handshakeAccesses);
+                    // lock is released between slices to let bus masters in
+                    lock (this)
+                    {
+                        instructionsExecutedThisRound += ExecuteSteps(slice);
+                    }
+                    toExecute -= slice;
+                    AdaptQuantumSlice(slice, Interlocked.Read(ref handshakeAccesses) != accesses);
                 }
             }
             catch (Exception)
@@ -249,6 +446,36 @@ namespace Antmicro.Renode.Peripherals.CPU
             return ExecutionResult.Ok;
         }
 
+        // PIO that is exchanging data with bus masters is executed in shorter slices,
+        // so FIFO and IRQ handshakes see each other sooner. Self-contained PIO slices grow back
+        // up to the whole quantum given by Renode.
+        private void AdaptQuantumSlice(ulong executedSlice, bool handshake)
+        {
+            if (handshake)
+            {
+                quantumSlice = Math.Max(MinimumQuantumSlice, executedSlice / 2);
+            }
+            else if (quantumSlice < MaximumQuantumSlice)
+            {
+                quantumSlice = Math.Min(MaximumQuantumSlice, quantumSlice * 2);
+            }
+        }
+
+        public ulong QuantumSlice => quantumSlice;
+
+        // Only FIFO data and IRQ flag updates hand work over between PIO and a bus master.
+        // Status polling (FSTAT, FLEVEL, IRQ reads) does not shorten the slices.
+        private void NoteBusAccess(long offset, bool write)
+        {
+            bool handshake = write
+                ? (offset >= TxFifoOffset && offset < RxFifoOffset) || offset == IrqOffset || offset == IrqForceOffset
+                : offset >= RxFifoOffset && offset < IrqOffset;
+            if (handshake)
+            {
+                Interlocked.Increment(ref handshakeAccesses);
+            }
+        }
+
         public override string Architecture => "RP2040_PIO";
 
         public override RegisterValue PC
@@ -273,6 +500,7 @@ namespace Antmicro.Renode.Peripherals.CPU
         [Export]
         protected virtual void GpioPinWriteBitset(uint bitset, uint bitmap)
         {
+            ++gpioCallbacks;
             gpio.ClearGpioBitset((~bitset) & bitmap, gpioFunction);
             gpio.SetGpioBitset(bitset, gpioFunction, bitmap);
         }
@@ -280,18 +508,21 @@ namespace Antmicro.Renode.Peripherals.CPU
         [Export]
         protected virtual void GpioPindirWriteBitset(uint bitset, uint bitmap)
         {
+            ++gpioCallbacks;
             gpio.SetPinDirectionBitset(bitset, bitmap);
         }
 
         [Export]
         protected virtual int GpioGetPinState(uint pin)
         {
+            ++gpioCallbacks;
             return Convert.ToInt32(this.gpio.GetGpioState(pin));
         }
 
         [Export]
         protected virtual uint GetGpioPinBitmap()
         {
+            ++gpioCallbacks;
             return (uint)this.gpio.GetGpioStateBitmap();
         }
 
@@ -299,8 +530,22 @@ namespace Antmicro.Renode.Peripherals.CPU
 
         public override ulong ExecutedInstructions => totalExecutedInstructions;
 
+        // CTRL.SM_ENABLE as last written by a bus master, tells other peripherals whether PIO may be sampling pins
+        public bool AnyStateMachineEnabled => anyStateMachineEnabled;
+
+        public ulong SimulatedCycles => simulatedCycles;
+        public ulong NativeCalls => nativeCalls;
+        public ulong GpioCallbacks => gpioCallbacks;
+        public double HostExecutionSeconds => (double)hostExecutionTicks / Stopwatch.Frequency;
+        // simulated PIO cycles per second of host time spent inside piosim
+        public double SimulatedCyclesPerHostSecond => hostExecutionTicks == 0 ? 0 : simulatedCycles / HostExecutionSeconds;
+
         private ulong instructionsExecutedThisRound;
         private ulong totalExecutedInstructions;
+        private ulong simulatedCycles;
+        private ulong nativeCalls;
+        private ulong gpioCallbacks;
+        private long hostExecutionTicks;
         // [This needs to be mapped to the id of the Program Counter register used by the simulator]
         private const int PCRegisterId = 0;
         private int pioId;
@@ -309,6 +554,35 @@ namespace Antmicro.Renode.Peripherals.CPU
         [Transient]
         private NativeBinder binder;
 
+        private struct PendingWrite
+        {
+            public long Offset;
+            public uint Value;
+        }
+
+        private const int MaxPendingWrites = 64;
+        private const ulong MinimumQuantumSlice = 256;
+        private const ulong MaximumQuantumSlice = uint.MaxValue;
+        private ulong quantumSlice = MaximumQuantumSlice;
+        private long handshakeAccesses;
+        private const long ControlOffset = 0x0;
+        private const long TxFifoOffset = 0x10;
+        private const long RxFifoOffset = 0x20;
+        private const long IrqOffset = 0x30;
+        private const long IrqForceOffset = 0x34;
+        private const uint StateMachineEnableMask = 0xf;
+        private volatile bool anyStateMachineEnabled;
+        private readonly ConcurrentQueue<PendingWrite> pendingWrites = new ConcurrentQueue<PendingWrite>();
+
+        private const long StimulusRecordSize = 16;
+        [Transient]
+        private MemoryMappedFile stimulusFile;
+        [Transient]
+        private MemoryMappedViewAccessor stimulus;
+        private long stimulusRecords;
+        private long stimulusIndex;
+        private ulong stimulusCycle;
+
         public long Size { get { return 0x1000; } }
         public const ulong aliasSize = 0x1000;
         public const ulong xorAliasOffset = 0x1000;
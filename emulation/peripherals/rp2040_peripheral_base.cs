@@ -22,6 +22,20 @@ namespace Antmicro.Renode.Peripherals
         void WriteDoubleWordClear(long offset, uint value);
     }
 
+    // Implemented by peripherals driving DMA DREQs, so a single DREQ pulse can move
+    // as many elements as the peripheral FIFOs allow at that moment
+    public interface IRP2040DmaCreditProvider
+    {
+        // DREQ paced by DmaWriteCredit, null when the peripheral has none
+        GPIO DmaWriteRequest { get; }
+        // elements that can be written by DMA without overflowing the peripheral
+        int DmaWriteCredit { get; }
+        // DREQ paced by DmaReadCredit, null when the peripheral has none
+        GPIO DmaReadRequest { get; }
+        // elements that are ready to be read by DMA
+        int DmaReadCredit { get; }
+    }
+
     public abstract class RP2040PeripheralBase : BasicDoubleWordPeripheral, IBytePeripheral, IWordPeripheral, IRP2040Peripheral
     {
         public RP2040PeripheralBase(IMachine machine, ulong address) : base(machine)
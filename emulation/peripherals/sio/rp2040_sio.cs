@@ -15,6 +15,10 @@ using Antmicro.Renode.Core;
 using Antmicro.Renode.Core.Structure.Registers;
 using Antmicro.Renode.Logging;
 using Antmicro.Renode.Peripherals.Bus;
+using Antmicro.Renode.Peripherals.CPU;
+using Antmicro.Renode.Peripherals.IRQControllers;
+using Antmicro.Renode.Peripherals.Timers;
+using Antmicro.Renode.Time;
 
 using Antmicro.Renode.Peripherals.GPIOPort;
 
@@ -130,7 +134,7 @@ namespace Antmicro.Renode.Peripherals.Miscellaneous
             SPINLOCK_31 = 0x17c,
         }
 
-        public RP2040SIO(Machine machine, RP2040GPIO gpio, RP2040GPIO gpioQspi, ulong address) : base(machine, address)
+        public RP2040SIO(Machine machine, RP2040GPIO gpio, RP2040GPIO gpioQspi, NVIC nvic0, NVIC nvic1, ulong address) : base(machine, address)
         {
             cpuFifo = new Queue<long>[2];
             fifoStatus = new FifoStatus[2];
@@ -139,9 +143,26 @@ namespace Antmicro.Renode.Peripherals.Miscellaneous
             Core0IRQ = new GPIO();
             Core1IRQ = new GPIO();
             coreSynchronization = new object();
+            parkedCpu = new ICPU[2];
+            parkTimers = new LimitTimer[2];
+            lastIdlePollPc = new ulong[2];
+            lastIdlePollInstructions = new ulong[2];
+            idlePolls = new int[2];
+            nvic = new NVIC[] { nvic0, nvic1 };
 
             for (int i = 0; i < 2; ++i)
             {
+                int id = i;
+                parkTimers[i] = new LimitTimer(machine.ClockSource, 1000000, this, "ParkTimer" + i, ParkTimeoutMicroseconds, direction: Direction.Ascending, enabled: false, workMode: WorkMode.OneShot, eventEnabled: true);
+                parkTimers[i].LimitReached += () => Wake(id);
+                // a parked core has to take its interrupts as soon as they become pending
+                nvic[i].IRQ.AddStateChangedHook(pending =>
+                {
+                    if (pending)
+                    {
+                        Wake(id);
+                    }
+                });
                 divider[i] = new Divider();
                 cpuFifo[i] = new Queue<long>();
                 fifoStatus[i] = new FifoStatus
@@ -173,6 +194,11 @@ namespace Antmicro.Renode.Peripherals.Miscellaneous
                 fifoStatus[i].Wof = false;
                 fifoStatus[i].Rdy = true;
                 fifoStatus[i].Vld = false;
+                parkTimers[i].Reset();
+                parkedCpu[i] = null;
+                lastIdlePollPc[i] = 0;
+                lastIdlePollInstructions[i] = 0;
+                idlePolls[i] = 0;
             }
 
             Core0IRQ.Unset();
@@ -191,6 +217,73 @@ namespace Antmicro.Renode.Peripherals.Miscellaneous
             return cpuId == 0 ? 1 : 0;
         }
 
+        // Cores spinning on an empty mailbox, a full mailbox or a taken spinlock are halted
+        // until the other core changes that state or an interrupt becomes pending.
+        // A core counts as spinning when the same instruction keeps failing to poll,
+        // at most SpinLoopInstructions apart and with no SIO progress in between.
+        // ExecutedInstructions advances per translation block, so work done between polls
+        // is counted once its blocks finish and breaks the chain. SEV is not visible here,
+        // so parking is additionally bounded by a short timeout.
+        private void NoteIdlePoll(int cpuId)
+        {
+            var cpu = machine.SystemBus.GetCurrentCPU();
+            var pc = cpu.PC.RawValue;
+            var executed = cpu.ExecutedInstructions;
+            if (pc != lastIdlePollPc[cpuId] || executed - lastIdlePollInstructions[cpuId] > SpinLoopInstructions)
+            {
+                lastIdlePollPc[cpuId] = pc;
+                idlePolls[cpuId] = 0;
+            }
+            lastIdlePollInstructions[cpuId] = executed;
+            if (++idlePolls[cpuId] < ParkAfterIdlePolls)
+            {
+                return;
+            }
+            idlePolls[cpuId] = 0;
+            if (nvic[cpuId].IRQ.IsSet)
+            {
+                return;
+            }
+
+            lock (coreSynchronization)
+            {
+                parkedCpu[cpuId] = cpu;
+                parkTimers[cpuId].Value = 0;
+                parkTimers[cpuId].Enabled = true;
+            }
+            machine.LocalTimeSource.ExecuteInNearestSyncedState(_ =>
+            {
+                lock (coreSynchronization)
+                {
+                    if (parkedCpu[cpuId] == cpu && !nvic[cpuId].IRQ.IsSet)
+                    {
+                        cpu.IsHalted = true;
+                    }
+                }
+            });
+        }
+
+        private void NoteProgress(int cpuId)
+        {
+            idlePolls[cpuId] = 0;
+        }
+
+        private void Wake(int cpuId)
+        {
+            ICPU cpu;
+            lock (coreSynchronization)
+            {
+                cpu = parkedCpu[cpuId];
+                if (cpu == null)
+                {
+                    return;
+                }
+                parkedCpu[cpuId] = null;
+                parkTimers[cpuId].Enabled = false;
+            }
+            machine.LocalTimeSource.ExecuteInNearestSyncedState(_ => cpu.IsHalted = false);
+        }
+
         private void DefineRegisters()
         {
             Registers.CPUID.Define(this)
@@ -311,7 +404,18 @@ namespace Antmicro.Renode.Peripherals.Miscellaneous
 
             Registers.FIFO_ST.Define(this)
                 .WithFlag(0, FieldMode.Read,
-                    valueProviderCallback: _ => fifoStatus[CurrentCpu()].Vld,
+                    valueProviderCallback: _ =>
+                    {
+                        // VLD is evaluated on every FIFO_ST read, so polls of an empty
+                        // mailbox and of a full outgoing one are both noted here
+                        var cpuId = CurrentCpu();
+                        var valid = fifoStatus[cpuId].Vld;
+                        if (!valid || !fifoStatus[cpuId == 0 ? 1 : 0].Rdy)
+                        {
+                            NoteIdlePoll(cpuId);
+                        }
+                        return valid;
+                    },
                     name: "FIFO_ST_VLD")
                 .WithFlag(1, FieldMode.Read,
                     valueProviderCallback: _ => fifoStatus[OtherCpu()].Rdy,
@@ -356,6 +460,7 @@ namespace Antmicro.Renode.Peripherals.Miscellaneous
                         {
                             var cpu = machine.SystemBus.GetCurrentCPU();
                             var cpuId = machine.SystemBus.GetCPUSlot(cpu);
+                            NoteProgress(cpuId);
                             if (cpuFifo[cpuId].Count != 0)
                             {
                                 fifoStatus[cpuId].Roe = false;
@@ -365,6 +470,8 @@ namespace Antmicro.Renode.Peripherals.Miscellaneous
                                     fifoStatus[cpuId].Vld = false;
                                 }
                                 fifoStatus[cpuId].Rdy = true;
+                                // a writer may be parked waiting for free space
+                                Wake(cpuId == 0 ? 1 : 0);
                                 return ret;
                             }
                             else
@@ -385,6 +492,7 @@ namespace Antmicro.Renode.Peripherals.Miscellaneous
                         var cpuId = machine.SystemBus.GetCPUSlot(cpu);
 
                         long otherCpu = Convert.ToInt64(cpuId == 0);
+                        NoteProgress(cpuId);
 
                         lock (coreSynchronization)
                         {
@@ -404,6 +512,7 @@ namespace Antmicro.Renode.Peripherals.Miscellaneous
                                 fifoStatus[otherCpu].Wof = true;
                             }
                         }
+                        Wake((int)otherCpu);
                         if (cpuId == 0)
                         {
                             Core1IRQ.Set(true);
@@ -522,6 +631,7 @@ namespace Antmicro.Renode.Peripherals.Miscellaneous
                                 if (cpu == spinlocks[id])
                                 {
                                     spinlocks[id] = 0;
+                                    Wake(cpu == 0 ? 1 : 0);
                                 }
                             },
                             valueProviderCallback: _ =>
@@ -530,8 +640,10 @@ namespace Antmicro.Renode.Peripherals.Miscellaneous
                                 if (spinlocks[id] == 0 || spinlocks[id] == cpu)
                                 {
                                     spinlocks[id] = cpu;
+                                    NoteProgress(cpu);
                                     return (ulong)(1 << id);
                                 }
+                                NoteIdlePoll(cpu);
                                 return 0;
                             },
                             name: r.ToString());
@@ -548,5 +660,15 @@ namespace Antmicro.Renode.Peripherals.Miscellaneous
         private RP2040GPIO gpio;
         private RP2040GPIO gpioQspi;
         private object coreSynchronization;
+        private readonly ICPU[] parkedCpu;
+        private readonly LimitTimer[] parkTimers;
+        private readonly ulong[] lastIdlePollPc;
+        private readonly ulong[] lastIdlePollInstructions;
+        private readonly int[] idlePolls;
+        private readonly NVIC[] nvic;
+
+        private const int ParkAfterIdlePolls = 32;
+        private const ulong SpinLoopInstructions = 64;
+        private const ulong ParkTimeoutMicroseconds = 20;
     }
 }
@@ -12,6 +12,7 @@ using Antmicro.Renode.Core;
 using Antmicro.Renode.Logging;
 using System;
 using System.Collections.Generic;
+using System.Linq;
 using Antmicro.Renode.Core.Structure.Registers;
 using Antmicro.Renode.Utilities.Collections;
 using Antmicro.Renode.Peripherals.GPIOPort;
@@ -107,14 +108,51 @@ namespace Antmicro.Renode.Peripherals.SPI
       {
         newFrequency = 1;
       }
-      if (newFrequency != this._executionThread.Frequency)
+      if (newFrequency != bitFrequency)
       {
-        this._executionThread.Frequency = newFrequency;
+        bitFrequency = newFrequency;
         this.Log(LogLevel.Debug, "SPI" + id + ": Changed frequency to: " + newFrequency);
         steps = clocks.SystemClockFrequency / newFrequency;
+        UpdateThreadFrequency();
       }
     }
 
+    // Bit-level stepping takes two steps per bit, while in transaction-level mode a single step
+    // closes the previous frame and exchanges the next one, so the thread is slowed down
+    // to keep the same frame rate
+    private void UpdateThreadFrequency()
+    {
+      uint frequency = bitFrequency;
+      if (transactionLevel && dataSize > 0)
+      {
+        frequency = Math.Max(1, frequency / (2u * dataSize));
+      }
+      this._executionThread.Frequency = frequency;
+    }
+
+    // Bit-level stepping is only needed when something may sample the SPI pins
+    private bool ArePinsObserved()
+    {
+      foreach (var pin in txPins.Concat(clockPins))
+      {
+        if (gpio.GetGpio(pin).IsConnected)
+        {
+          return true;
+        }
+      }
+      if (pios == null)
+      {
+        pios = machine.GetPeripheralsOfType<CPU.RP2040PIOCPU>().ToArray();
+      }
+      return pios.Any(pio => pio.AnyStateMachineEnabled);
+    }
+
+    // Nothing drives RX synchronously, so its current level is shifted in for every bit
+    private ushort ExchangeFrame()
+    {
+      return ReadMultiplePins(rxPins) ? (ushort)((1 << dataSize) - 1) : (ushort)0;
+    }
+
     private void OnGpioFunctionSelect(int pin, RP2040GPIO.GpioFunction function)
     {
       if (id == 0)
@@ -241,9 +279,29 @@ namespace Antmicro.Renode.Peripherals.SPI
           SetMultiplePins(clockPins, false);
           _executionThread.Stop();
           running = false;
+          if (transactionLevel)
+          {
+            // the next burst starts at a frame boundary instead of exchanging a filler frame
+            transmitCounter = dataSize;
+            return;
+          }
+        }
+
+        if (ArePinsObserved() == transactionLevel)
+        {
+          transactionLevel = !transactionLevel;
+          this.Log(LogLevel.Debug, "SPI{0}: Switched to {1} mode", id, transactionLevel ? "transaction-level" : "bit-level");
+          UpdateThreadFrequency();
         }
       }
 
+      if (transactionLevel)
+      {
+        receiveData = ExchangeFrame();
+        transmitCounter = dataSize;
+        return;
+      }
+
       bool clockWasHigh = ReadMultiplePins(clockPins);
       SetMultiplePins(clockPins, !clockWasHigh);
       if (!clockWasHigh)
@@ -305,19 +363,25 @@ namespace Antmicro.Renode.Peripherals.SPI
       masterSlaveSelect = false;
       slaveModeDisabled = false;
       running = false;
+      transactionLevel = false;
       clockPrescaleDivisor = 2;
       steps = 0;
       transmitCounter = 16;
       transmitData = 0;
       receiveData = 0;
       UpdateFrequency(clocks.PeripheralClockFrequency);
+      UpdateThreadFrequency();
     }
 
     private void DefineRegisters()
     {
       Registers.SSPCR0.Define(registers)
         .WithValueField(0, 4, valueProviderCallback: _ => (ulong)(dataSize - 1),
-          writeCallback: (_, value) => dataSize = (byte)(value + 1), name: "SSPCR0_DSS")
+          writeCallback: (_, value) =>
+          {
+            dataSize = (byte)(value + 1);
+            UpdateThreadFrequency();
+          }, name: "SSPCR0_DSS")
         .WithValueField(4, 2, valueProviderCallback: _ => (ulong)frameFormat,
           writeCallback: (_, value) => frameFormat = (byte)value, name: "SSPCR0_FRF")
         .WithFlag(6, valueProviderCallback: _ => clockPolarity,
@@ -466,6 +530,9 @@ namespace Antmicro.Renode.Peripherals.SPI
     }
     private ulong steps;
     private ulong periFrequency;
+    private uint bitFrequency;
+    private bool transactionLevel;
+    private CPU.RP2040PIOCPU[] pios;
     private RP2040Clocks clocks;
   }
 }
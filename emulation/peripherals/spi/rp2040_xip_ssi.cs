@@ -22,10 +22,15 @@ using Xwt;
 namespace Antmicro.Renode.Peripherals.SPI
 {
   // Slave mode is not yet supported, XIP mode is not implemented since underlaying memory is mapped
-  public class RP2040XIPSSI : NullRegistrationPointPeripheralContainer<ISPIPeripheral>, IDoubleWordPeripheral, IKnownSize
+  public class RP2040XIPSSI : NullRegistrationPointPeripheralContainer<ISPIPeripheral>, IDoubleWordPeripheral, IKnownSize, IRP2040DmaCreditProvider
   {
     public long Size { get { return 0x1000; } }
 
+    public GPIO DmaWriteRequest => DmaTransmitDreq;
+    public int DmaWriteCredit => transmitBuffer.Capacity - transmitBuffer.Count;
+    public GPIO DmaReadRequest => DmaStreamDreq;
+    public int DmaReadCredit => receiveBuffer.Count;
+
     public const ulong aliasSize = 0x1000;
     public const ulong xorAliasOffset = 0x1000;
     public const ulong setAliasOffset = 0x2000;
@@ -196,6 +201,8 @@ namespace Antmicro.Renode.Peripherals.SPI
       commandBytesTransferred = 0;
       cyclesToWait = 0;
       framesToTransfer = 0;
+      readAheadPosition = 0;
+      readAheadLength = 0;
 
       RecalculateFrequencies();
     }
@@ -306,8 +313,7 @@ namespace Antmicro.Renode.Peripherals.SPI
               }
               else
               {
-                state = State.Data;
-                framesToTransfer = (int)numberOfDataFrames.Value + 1;
+                BeginDataPhase();
               }
               return;
             }
@@ -336,8 +342,7 @@ namespace Antmicro.Renode.Peripherals.SPI
               this.Log(LogLevel.Noisy, "Wait cycles are necessary, waiting for: {0}", cyclesToWait);
               return;
             }
-            state = State.Data;
-            framesToTransfer = (int)numberOfDataFrames.Value + 1;
+            BeginDataPhase();
             this.Log(LogLevel.Noisy, "Data frames to transfer: {0}", framesToTransfer);
             return;
           }
@@ -347,8 +352,7 @@ namespace Antmicro.Renode.Peripherals.SPI
             {
               RegisteredPeripheral.Transmit(0x00);
             }
-            state = State.Data;
-            framesToTransfer = (int)numberOfDataFrames.Value + 1;
+            BeginDataPhase();
             return;
           }
         case State.Data:
@@ -356,9 +360,10 @@ namespace Antmicro.Renode.Peripherals.SPI
             this.Log(LogLevel.Noisy, "Transmiting data frames left: " + framesToTransfer);
             int dataSize = (int)Math.Ceiling((double)dataFrameSize32.Value / 8);
             // if tmod is read only
-            PushToReceiveFifo(WriteToDevice(0, (int)dataFrameSize32.Value + 1));
+            PushToReceiveFifo(ReadDataFrame((int)dataFrameSize32.Value + 1));
             if (--framesToTransfer <= 0)
             {
+              readAheadLength = 0;
               clockingThread.Stop();
             }
             return;
@@ -366,6 +371,42 @@ namespace Antmicro.Renode.Peripherals.SPI
       }
     }
 
+    private void BeginDataPhase()
+    {
+      state = State.Data;
+      framesToTransfer = (int)numberOfDataFrames.Value + 1;
+      readAheadPosition = 0;
+      readAheadLength = 0;
+
+      // Reads from flash are fetched as one block, frames are still pushed at SSI clock rate
+      if (RegisteredPeripheral is W25QXX flash)
+      {
+        var length = framesToTransfer * (((int)dataFrameSize32.Value + 8) / 8);
+        if (readAhead == null || readAhead.Length < length)
+        {
+          readAhead = new byte[length];
+        }
+        if (flash.TryReadBlock(readAhead, 0, length))
+        {
+          readAheadLength = length;
+        }
+      }
+    }
+
+    uint ReadDataFrame(int bits)
+    {
+      if (readAheadPosition >= readAheadLength)
+      {
+        return WriteToDevice(0, bits);
+      }
+      uint received = 0;
+      for (int i = 0; i < bits; i += 8)
+      {
+        received |= (uint)readAhead[readAheadPosition++] << i;
+      }
+      return received;
+    }
+
     void ProcessTransmit()
     {
       if (!transmitBuffer.TryDequeue(out var data))
@@ -666,6 +707,9 @@ namespace Antmicro.Renode.Peripherals.SPI
     private int commandBytesTransferred;
     private int cyclesToWait;
     private int framesToTransfer;
+    private byte[] readAhead;
+    private int readAheadPosition;
+    private int readAheadLength;
 
     private RP2040Clocks clocks;
     private enum Registers
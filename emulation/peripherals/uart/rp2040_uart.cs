@@ -17,7 +17,7 @@ using System.Linq;
 namespace Antmicro.Renode.Peripherals.UART
 {
     [AllowedTranslations(AllowedTranslation.ByteToDoubleWord | AllowedTranslation.WordToDoubleWord | AllowedTranslation.DoubleWordToByte)]
-    public class RP2040Uart : UARTBase, IRP2040Peripheral, IProvidesRegisterCollection<DoubleWordRegisterCollection>
+    public class RP2040Uart : UARTBase, IRP2040Peripheral, IRP2040DmaCreditProvider, IProvidesRegisterCollection<DoubleWordRegisterCollection>
     {
         public RP2040Uart(IMachine machine, ulong address, uint fifoSize = 1, uint frequency = 24000000) : base(machine)
         {
@@ -100,6 +100,26 @@ namespace Antmicro.Renode.Peripherals.UART
         public const ulong xorAliasOffset = 0x1000;
         public const ulong setAliasOffset = 0x2000;
         public const ulong clearAliasOffset = 0x3000;
+
+        // Characters are sent out immediately, so the whole TX FIFO is free on every
+        // DREQ pulse. Pulses are spread accordingly to keep the transmit rate.
+        public GPIO DmaWriteRequest => DMATransmitRequest;
+        public int DmaWriteCredit => (int)TransmitBurst;
+        public GPIO DmaReadRequest => DMAReceiveRequest;
+        public int DmaReadCredit => dmaRxEnable.Value ? Count : 0;
+
+        private uint TransmitBurst => enableFifoBuffers.Value ? hardwareFifoSize : 1;
+
+        private void UpdateDreqGenerator()
+        {
+            dreqGenerator.Stop();
+            dreqGenerator.Frequency = System.Math.Max(1, BaudRate / 8 / TransmitBurst);
+            if (dreqGeneratorEnabled)
+            {
+                dreqGenerator.Start();
+            }
+        }
+
         private void TriggerDREQ()
         {
             if (Count > 0 && dmaRxEnable.Value)
@@ -307,7 +327,7 @@ namespace Antmicro.Renode.Peripherals.UART
                 .WithFlag(1, out parityEnable, name: "PEN - Parity enable")
                 .WithFlag(2, out evenParitySelect, name: "EPS - Even parity select")
                 .WithFlag(3, out twoStopBitsSelect, name: "STP2 - Two stop bits select")
-                .WithFlag(4, out enableFifoBuffers, name: "FEN - Enable FIFOs", changeCallback: (_, __) => UpdateReceiveFifoSize())
+                .WithFlag(4, out enableFifoBuffers, name: "FEN - Enable FIFOs", changeCallback: (_, __) => { UpdateReceiveFifoSize(); UpdateDreqGenerator(); })
                 .WithEnumField(5, 2, out wordLength, name: "WLEN - Word length")
                 .WithFlag(7, out stickParitySelect, name: "SPS - Stick parity select")
                 .WithReservedBits(8, 8)
@@ -328,12 +348,7 @@ namespace Antmicro.Renode.Peripherals.UART
                     writeCallback: (_, value) =>
                     {
                         integerBaudRate = value;
-                        dreqGenerator.Stop();
-                        dreqGenerator.Frequency = BaudRate / 8;
-                        if (dreqGeneratorEnabled)
-                        {
-                            dreqGenerator.Start();
-                        }
+                        UpdateDreqGenerator();
 
                     }, name: "BAUD DIVINT - The integer baud rate divisor.")
                 ;
@@ -343,12 +358,7 @@ namespace Antmicro.Renode.Peripherals.UART
                     writeCallback: (_, value) =>
                     {
                         fractionalBaudRate = value;
-                        dreqGenerator.Stop();
-                        dreqGenerator.Frequency = BaudRate / 8;
-                        if (dreqGeneratorEnabled)
-                        {
-                            dreqGenerator.Start();
-                        }
+                        UpdateDreqGenerator();
                     }, name: "BAUD DIVFRAC - The fractional baud rate divisor")
                 .WithReservedBits(6, 10)
                 ;